@@ -0,0 +1,81 @@
+#ifndef NET_EMULATION_H
+#define NET_EMULATION_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+
+// Link conditions to emulate in user space
+struct NetworkProfile {
+    const char* name;
+    double mbps;          // bottleneck bandwidth
+    double rtt_ms;        // round-trip time; each direction adds half
+    double jitter_ms;     // standard deviation of the per-message delay
+    size_t burst_bytes;   // token bucket depth
+};
+
+inline constexpr NetworkProfile NETWORK_PROFILES[] = {
+    {"LAN",    1000.0,  0.5,  0.05, 64 * 1024},
+    {"WAN",     100.0, 40.0,  2.0,  64 * 1024},
+    {"mobile",   10.0, 80.0, 10.0,  32 * 1024},
+};
+
+// Profile by name, or nullptr
+inline const NetworkProfile* findNetworkProfile(const std::string& name) {
+    for (const NetworkProfile& profile : NETWORK_PROFILES) {
+        if (name == profile.name) {
+            return &profile;
+        }
+    }
+    return nullptr;
+}
+
+// One direction of an emulated link. A token bucket decides when each
+// message has been serialized onto the link, then a delay queue adds half
+// the RTT plus jitter. Messages are delivered in order (a later message
+// never overtakes an earlier one), as on a TCP connection. Times are in
+// seconds on whatever clock the caller passes in.
+class LinkEmulator {
+public:
+    LinkEmulator(const NetworkProfile& profile, uint64_t seed)
+        : bytes_per_second(profile.mbps * 1e6 / 8),
+          one_way_delay(profile.rtt_ms / 2000),
+          burst(static_cast<double>(profile.burst_bytes)),
+          tokens(static_cast<double>(profile.burst_bytes)),
+          jitter(0.0, profile.jitter_ms / 1000),
+          rng(seed) {}
+
+    // When a message of `bytes` handed to the link at `now` has fully arrived
+    double deliveryTime(double now, size_t bytes) {
+        now = std::max(now, bucket_time);
+        tokens = std::min(burst, tokens + (now - bucket_time) * bytes_per_second);
+        bucket_time = now;
+
+        double departure = now;
+        if (tokens >= bytes) {
+            tokens -= bytes;
+        } else {
+            departure += (bytes - tokens) / bytes_per_second;
+            tokens = 0;
+            bucket_time = departure;
+        }
+
+        double arrival = departure + std::max(0.0, one_way_delay + jitter(rng));
+        last_arrival = std::max(arrival, last_arrival);
+        return last_arrival;
+    }
+
+private:
+    double bytes_per_second;
+    double one_way_delay;
+    double burst;
+    double tokens;
+    double bucket_time = 0;
+    double last_arrival = 0;
+    std::normal_distribution<double> jitter;
+    std::mt19937_64 rng;
+};
+
+#endif // NET_EMULATION_H
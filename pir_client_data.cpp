@@ -8,11 +8,20 @@
 #include <stdexcept>
 #include <sstream> // For SEAL serialization/deserialization simulation
 #include <fstream> // For saving serialized data if needed
+#include <memory>
+#include <iomanip>
+#include "net_emulation.h" // Link profiles for the network-aware comparison
 
 // --- Conditional Includes ---
 // Only include if needed, reduces compile time if testing one protocol
 #ifdef USE_EMP
 #include <emp-sh2pc/emp-sh2pc.h>
+#include <thread>
+#include <functional>
+#include <random>
+#include "selection_circuit.h"
+#include "spsc_ring.h"
+#include "sqrt_oram.h"
 using namespace emp;
 #endif
 
@@ -33,6 +42,9 @@ const int DB_N_RECORDS = 5;       // n
 const int DB_TOTAL_RECORDS = DB_M_CLIENTS * DB_N_RECORDS; // N
 const int DB_VALUE_BITSIZE = 4;   // 0-15 requires 4 bits minimum
 const int HE_PLAIN_MOD_BITSIZE = 20; // SEAL Plaintext modulus size (must hold results)
+const int GC_RECORD_BITSIZE = DB_VALUE_BITSIZE; // GC path takes any record width, e.g. 256 * 8
+const int GC_BATCH_QUERIES = 1;   // Lookups per GC run; the DB is fed once and shared by all of them
+const int GC_ORAM_SESSION_QUERIES = 64; // Lookups per 'gc-oram' session, all against one ORAM
 
 // Target query (example)
 const int TARGET_CLIENT_IDX = 3;
@@ -270,11 +282,185 @@ void run_pir_he(map<string, double>& timings, map<string, size_t>& comm_sizes) {
 
 
 #ifdef USE_EMP
+// ===============================================================
+// In-process Channel (EMP IO over shared memory)
+// ===============================================================
+// One end of a duplex channel between two threads of this process. Each
+// direction is a lock-free byte ring; a full (or empty) ring is waited out
+// by yielding. Drop-in for NetIO wherever EMP
+// takes an IO type, so both parties can run in one binary without the
+// kernel's TCP stack in the timings.
+class MemIO : public IOChannel<MemIO> {
+public:
+    // Both ends of a new channel (first for ALICE, second for BOB)
+    static pair<MemIO*, MemIO*> createPair(size_t ring_bytes = 1 << 22) {
+        auto a_to_b = make_shared<SpscRing<uint8_t>>(ring_bytes);
+        auto b_to_a = make_shared<SpscRing<uint8_t>>(ring_bytes);
+        return {new MemIO(a_to_b, b_to_a), new MemIO(b_to_a, a_to_b)};
+    }
+
+    void send_data_internal(const void* data, size_t len) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        while (len > 0) {
+            size_t moved = out->tryPushSome(bytes, len);
+            if (moved == 0) {
+                this_thread::yield();
+            }
+            bytes += moved;
+            len -= moved;
+        }
+    }
+
+    void recv_data_internal(void* data, size_t len) {
+        uint8_t* bytes = static_cast<uint8_t*>(data);
+        while (len > 0) {
+            size_t moved = in->tryPopSome(bytes, len);
+            if (moved == 0) {
+                this_thread::yield();
+            }
+            bytes += moved;
+            len -= moved;
+        }
+    }
+
+    void flush() {} // every send is already visible to the peer
+
+private:
+    MemIO(shared_ptr<SpscRing<uint8_t>> out_ring, shared_ptr<SpscRing<uint8_t>> in_ring)
+        : out(move(out_ring)), in(move(in_ring)) {}
+
+    shared_ptr<SpscRing<uint8_t>> out, in;
+};
+
+// Wraps another IO end with an emulated link (see net_emulation.h). Sends
+// are buffered like NetIO's stream and go out as one message on flush(),
+// before a receive, or once the buffer fills. Each message is stamped with
+// the time it is due at the peer, whose receive sleeps until then. Both
+// ends must share a clock, i.e. live in one process (MemIO).
+template<typename IO>
+class EmulatedIO : public IOChannel<EmulatedIO<IO>> {
+public:
+    EmulatedIO(IO* inner_io, const NetworkProfile& profile, uint64_t seed)
+        : inner(inner_io), link(profile, seed) {}
+
+    ~EmulatedIO() { flush(); }
+
+    void send_data_internal(const void* data, size_t len) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        pending.insert(pending.end(), bytes, bytes + len);
+        if (pending.size() >= FLUSH_BYTES) {
+            flush();
+        }
+    }
+
+    void recv_data_internal(void* data, size_t len) {
+        flush(); // whatever we sent must be on its way before we wait on the peer
+        uint8_t* bytes = static_cast<uint8_t*>(data);
+        while (len > 0) {
+            if (message_left == 0) {
+                MessageHeader header;
+                inner->recv_data(&header, sizeof(header));
+                this_thread::sleep_until(steady_clock::time_point(nanoseconds(header.due_ns)));
+                message_left = header.length;
+            }
+            size_t take = min<size_t>(len, message_left);
+            inner->recv_data(bytes, take);
+            bytes += take;
+            len -= take;
+            message_left -= take;
+        }
+    }
+
+    void flush() {
+        if (pending.empty()) {
+            return;
+        }
+        double now = duration<double>(steady_clock::now().time_since_epoch()).count();
+        MessageHeader header;
+        header.due_ns = static_cast<int64_t>(link.deliveryTime(now, pending.size()) * 1e9);
+        header.length = pending.size();
+        inner->send_data(&header, sizeof(header));
+        inner->send_data(pending.data(), pending.size());
+        inner->flush();
+        pending.clear();
+    }
+
+private:
+    static constexpr size_t FLUSH_BYTES = 1 << 16;
+
+    struct MessageHeader {
+        int64_t due_ns;   // steady_clock time the message is fully delivered
+        uint64_t length;
+    };
+
+    unique_ptr<IO> inner;
+    LinkEmulator link;        // our sending direction
+    vector<uint8_t> pending;  // sent but not yet flushed
+    uint64_t message_left = 0;
+};
+
 // ===============================================================
 // Garbled Circuit PIR Function (EMP-SH2PC)
 // ===============================================================
-// Function to perform the secure PIR computation using EMP Garbled Circuits
-void run_pir_gc(NetIO *io, int party, map<string, double>& timings) {
+// Bit ops on EMP bits for the builders in selection_circuit.h
+struct EmpBitOps {
+    using Bit = emp::Bit;
+
+    Bit AND(const Bit& a, const Bit& b) { return a & b; }
+    Bit XOR(const Bit& a, const Bit& b) { return a ^ b; }
+    Bit NOT(const Bit& a) { return !a; }
+
+    // Extra hooks used by sqrt_oram.h
+    Bit constant(bool value) { return Bit(value, PUBLIC); }
+
+    vector<Bit> feed(int owner, const vector<bool>& bits) {
+        vector<Bit> out(bits.size());
+        unique_ptr<bool[]> plain(new bool[bits.size()]);
+        copy(bits.begin(), bits.end(), plain.get());
+        ProtocolExecution::prot_exec->feed((block*)out.data(), owner, plain.get(), bits.size());
+        return out;
+    }
+
+    uint64_t revealPublic(const vector<Bit>& bits) {
+        unique_ptr<bool[]> plain(new bool[bits.size()]);
+        ProtocolExecution::prot_exec->reveal(plain.get(), PUBLIC, (block*)bits.data(), bits.size());
+        uint64_t value = 0;
+        for (size_t b = 0; b < bits.size(); ++b) {
+            value |= (uint64_t)plain[b] << b;
+        }
+        return value;
+    }
+
+    uint64_t randomWord() {
+        uint64_t word;
+        prg.random_data(&word, sizeof(word));
+        return word;
+    }
+
+    PRG prg;
+};
+
+// Hex string of a little-endian bit vector, most significant nibble first
+string bitsToHex(const bool* bits, int count) {
+    string hex;
+    for (int nibble = (count + 3) / 4 - 1; nibble >= 0; --nibble) {
+        int v = 0;
+        for (int b = 3; b >= 0; --b) {
+            int i = nibble * 4 + b;
+            v = (v << 1) | (i < count && bits[i]);
+        }
+        hex += "0123456789abcdef"[v];
+    }
+    return hex;
+}
+
+// Function to perform the secure PIR computation using EMP Garbled Circuits.
+// Looks up every index in target_indices (only the client's values are
+// used; the count is public) against a single feed of the database. With
+// use_oram the lookups go through a square-root ORAM instead of a linear
+// scan each. Runs on whatever channel setup_semi_honest was given.
+void run_pir_gc(int party, map<string, double>& timings, const vector<int>& target_indices,
+                bool use_oram = false) {
     cout << "\n--- Running PIR with Garbled Circuits (EMP-SH2PC) ---" << endl;
 
     high_resolution_clock::time_point time_start, time_end;
@@ -285,41 +471,42 @@ void run_pir_gc(NetIO *io, int party, map<string, double>& timings) {
 
     // --- Input Phase (Timing includes secure transfer) ---
     time_start = high_resolution_clock::now();
-    Integer client_index_k; // Secure integer for the client's desired index k
-    vector<Integer> server_db(DB_TOTAL_RECORDS); // Secure integers for server's DB
-
-    if (party == ALICE) { // Client provides the index k
-        int target_k = TARGET_CLIENT_IDX * DB_N_RECORDS + TARGET_RECORD_IDX;
-        if (target_k < 0 || target_k >= DB_TOTAL_RECORDS) {
-             throw runtime_error("[GC Client] Target index out of bounds!");
-        }
-        cout << "[GC Client] Providing target index k = " << target_k << endl;
-        client_index_k = Integer(INDEX_BITSIZE, target_k, ALICE);
-        // Server provides dummy inputs for the DB vector (size matters)
-        for (int i = 0; i < DB_TOTAL_RECORDS; ++i) {
-            server_db[i] = Integer(DB_VALUE_BITSIZE, 0, BOB);
+    const size_t num_queries = target_indices.size();
+    vector<Integer> client_index_k(num_queries); // Secure integers for the client's desired indices
+    // Server's DB as one record-major bit vector, fed in a single batch
+    vector<Bit> server_db(DB_TOTAL_RECORDS * GC_RECORD_BITSIZE);
+    unique_ptr<bool[]> db_plaintext(new bool[server_db.size()]()); // zeros stand in on the client
+
+    if (party == ALICE) { // Client provides the indices
+        for (size_t q = 0; q < num_queries; ++q) {
+            int target_k = target_indices[q];
+            if (target_k < 0 || target_k >= DB_TOTAL_RECORDS) {
+                 throw runtime_error("[GC Client] Target index out of bounds!");
+            }
+            cout << "[GC Client] Providing target index k = " << target_k << endl;
+            client_index_k[q] = Integer(INDEX_BITSIZE, target_k, ALICE);
         }
     } else { // Server (BOB) provides the database contents
-        // Client provides a dummy index
-        client_index_k = Integer(INDEX_BITSIZE, 0, ALICE);
+        // Client provides dummy indices
+        for (size_t q = 0; q < num_queries; ++q) {
+            client_index_k[q] = Integer(INDEX_BITSIZE, 0, ALICE);
+        }
 
         // Generate or load the actual database
-        vector<int> db_plaintext(DB_TOTAL_RECORDS);
         cout << "[GC Server] Generating dummy database..." << endl;
         srand(time(NULL) + 1); // Seed differently from HE if run close together
-        for (int i = 0; i < DB_TOTAL_RECORDS; ++i) {
-            db_plaintext[i] = rand() % 16; // Random value 0-15
+        for (size_t i = 0; i < server_db.size(); ++i) {
+            db_plaintext[i] = rand() & 1; // Random record bits
+        }
+        cout << "[GC Server] Sample DB (first 10, hex): ";
+        for(int i = 0; i < min(10, DB_TOTAL_RECORDS); ++i) {
+            cout << bitsToHex(&db_plaintext[i * GC_RECORD_BITSIZE], GC_RECORD_BITSIZE) << " ";
         }
-        cout << "[GC Server] Sample DB (first 10): ";
-        for(int i = 0; i < min(10, DB_TOTAL_RECORDS); ++i) cout << db_plaintext[i] << " ";
         cout << "..." << endl;
-
-        // Provide database values securely
         cout << "[GC Server] Providing database securely..." << endl;
-        for (int i = 0; i < DB_TOTAL_RECORDS; ++i) {
-            server_db[i] = Integer(DB_VALUE_BITSIZE, db_plaintext[i], BOB);
-        }
     }
+    // Every DB bit goes through one feed call instead of one Integer per record
+    ProtocolExecution::prot_exec->feed((block*)server_db.data(), BOB, db_plaintext.get(), server_db.size());
     // EMP performs secure input transfer here implicitly
     time_end = high_resolution_clock::now();
     duration_input = duration_cast<microseconds>(time_end - time_start).count() / 1e6;
@@ -331,14 +518,34 @@ void run_pir_gc(NetIO *io, int party, map<string, double>& timings) {
     cout << "GC Performing secure selection (circuit execution)..." << endl;
     time_start = high_resolution_clock::now(); // Start timing compute phase
 
-    Integer result(DB_VALUE_BITSIZE, 0, PUBLIC); // Start with public zero
-    Integer zero_value(DB_VALUE_BITSIZE, 0, PUBLIC);
-
-    for (int x = 0; x < DB_TOTAL_RECORDS; ++x) {
-        Integer current_x(INDEX_BITSIZE, x, PUBLIC);
-        Bit comparison_result = (client_index_k == current_x);
-        Integer selected_value = If(comparison_result, server_db[x], zero_value);
-        result = result + selected_value;
+    // Decoder tree over the index bits gives the one-hot selector vector
+    // (about N ANDs, log depth); each value bit is then the balanced XOR
+    // of (selector AND db bit), replacing N comparisons and an adder chain
+    EmpBitOps ops;
+    vector<Bit> result; // Query q's record at q * GC_RECORD_BITSIZE
+    if (use_oram) {
+        // One shuffle per epoch, then each lookup reveals a single random
+        // position and scans only the records touched since the shuffle
+        vector<vector<Bit>> records(DB_TOTAL_RECORDS);
+        for (int x = 0; x < DB_TOTAL_RECORDS; ++x) {
+            records[x].assign(server_db.begin() + x * GC_RECORD_BITSIZE, server_db.begin() + (x + 1) * GC_RECORD_BITSIZE);
+        }
+        high_resolution_clock::time_point init_start = high_resolution_clock::now();
+        SqrtOram<EmpBitOps> oram(ops, move(records), party, ALICE, BOB);
+        timings["GC ORAM Init"] = duration_cast<microseconds>(high_resolution_clock::now() - init_start).count() / 1e6;
+        for (size_t q = 0; q < num_queries; ++q) {
+            vector<Bit> record = oram.read(client_index_k[q].bits);
+            result.insert(result.end(), record.begin(), record.end());
+        }
+        cout << "GC ORAM: " << oram.period() << " lookups per epoch, " << oram.epochs() << " epoch(s) used" << endl;
+    } else {
+        for (size_t q = 0; q < num_queries; ++q) {
+            vector<Bit> one_hot = decodeOneHot(ops, client_index_k[q].bits, DB_TOTAL_RECORDS);
+            vector<Bit> record = selectByOneHot(ops, one_hot, GC_RECORD_BITSIZE, [&](const Bit& selector, size_t x, size_t b) {
+                return selector & server_db[x * GC_RECORD_BITSIZE + b];
+            });
+            result.insert(result.end(), record.begin(), record.end());
+        }
     }
 
     // Execution happens implicitly here and during reveal
@@ -351,7 +558,8 @@ void run_pir_gc(NetIO *io, int party, map<string, double>& timings) {
     // --- Output Phase (Timed) ---
     cout << "GC Revealing result to Client (ALICE)..." << endl;
     time_start = high_resolution_clock::now();
-    long long output_value = result.reveal<long long>(ALICE); // Reveal happens here
+    unique_ptr<bool[]> output_bits(new bool[result.size()]);
+    ProtocolExecution::prot_exec->reveal(output_bits.get(), ALICE, (block*)result.data(), result.size());
     time_end = high_resolution_clock::now();
     duration_reveal = duration_cast<microseconds>(time_end - time_start).count() / 1e6;
     timings["GC Result Reveal"] = duration_reveal;
@@ -361,7 +569,10 @@ void run_pir_gc(NetIO *io, int party, map<string, double>& timings) {
     // --- Post-Computation & Verification ---
     if (party == ALICE) {
         cout << "\n--- GC Verification ---" << endl;
-        cout << "[GC Client] Received Result: " << output_value << endl;
+        for (size_t q = 0; q < num_queries; ++q) {
+            cout << "[GC Client] Received Result for k = " << target_indices[q] << " (hex): "
+                 << bitsToHex(&output_bits[q * GC_RECORD_BITSIZE], GC_RECORD_BITSIZE) << endl;
+        }
         // Verification requires knowing the server's DB in this test setup
         // In practice, client wouldn't know this.
         // cout << "[GC Client] Expected Result (DB[" << target_k << "]): " << expected_result << endl;
@@ -369,6 +580,153 @@ void run_pir_gc(NetIO *io, int party, map<string, double>& timings) {
         cout << "[GC Server] Computation finished. Result revealed to Client." << endl;
     }
      timings["GC Total (Approx)"] = duration_input + duration_compute + duration_reveal; // Sum of phases
+     timings["GC Per Query (Approx)"] = timings["GC Total (Approx)"] / num_queries;
+     cout << "GC Retrieval throughput: " << (num_queries * GC_RECORD_BITSIZE / 8.0) / timings["GC Total (Approx)"]
+          << " bytes/s (" << num_queries << " x " << GC_RECORD_BITSIZE << "-bit records)" << endl;
+}
+
+// Batch of lookups starting at the example target
+vector<int> gcTargets(int count = GC_BATCH_QUERIES) {
+    vector<int> targets;
+    for (int q = 0; q < count; ++q) {
+        targets.push_back((TARGET_CLIENT_IDX * DB_N_RECORDS + TARGET_RECORD_IDX + q) % DB_TOTAL_RECORDS);
+    }
+    return targets;
+}
+
+// Runs both parties of a GC protocol (party_body, e.g. run_pir_gc) on two
+// threads of this process. Each IO end is made on its party's thread, since
+// NetIO's constructor blocks until the peer connects. Returns ALICE's
+// timings; the bytes each side sent are written to alice_sent / bob_sent.
+template<typename IO>
+map<string, double> run_gc_parties_local(function<IO*()> make_alice_io, function<IO*()> make_bob_io,
+                                         function<void(IO*, int, map<string, double>&)> party_body,
+                                         uint64_t& alice_sent, uint64_t& bob_sent) {
+#ifndef THREADING
+    // EMP keeps the active protocol in one global unless built per-thread;
+    // main rejects the in-process modes before getting here
+    throw runtime_error("Both GC parties in one process need emp-tool built with -DTHREADING");
+#endif
+    map<string, double> alice_timings, bob_timings;
+    exception_ptr alice_error, bob_error;
+    auto run_party = [&](function<IO*()>& make_io, int party, map<string, double>& timings,
+                         uint64_t& sent, exception_ptr& error) {
+        try {
+            IO* io = make_io();
+            auto run_start = high_resolution_clock::now();
+            setup_semi_honest(io, party);
+            party_body(io, party, timings);
+            finalize_semi_honest();
+            timings["GC End-to-End (incl. OT setup)"] =
+                duration_cast<microseconds>(high_resolution_clock::now() - run_start).count() / 1e6;
+            sent = io->counter;
+            delete io;
+        } catch (...) {
+            error = current_exception();
+        }
+    };
+    thread bob([&] { run_party(make_bob_io, BOB, bob_timings, bob_sent, bob_error); });
+    run_party(make_alice_io, ALICE, alice_timings, alice_sent, alice_error);
+    bob.join();
+    if (alice_error) rethrow_exception(alice_error);
+    if (bob_error) rethrow_exception(bob_error);
+    return alice_timings;
+}
+
+// Amortized cost of a session of lookups: square-root ORAM against one
+// linear scan per lookup, on a random records x record_bits DB. DB and
+// lookups come from a fixed seed so ALICE can check every result (only
+// BOB's copy of the DB is fed). Measured: a few linear lookups, the ORAM's
+// first shuffle and every lookup of one epoch; longer sessions repeat that
+// epoch, so their totals are composed from it.
+template<typename IO>
+void benchmarkOram(IO* io, int party, size_t records, int record_bits, map<string, double>& timings) {
+    const size_t LINEAR_SAMPLES = 8;
+    const size_t SESSION_LENGTHS[] = {1, 10, 100, 1000, 10000};
+
+    mt19937_64 rng(20240611);
+    unique_ptr<bool[]> db_plaintext(new bool[records * record_bits]);
+    for (size_t i = 0; i < records * record_bits; ++i) {
+        db_plaintext[i] = rng() & 1;
+    }
+    vector<Bit> server_db(records * record_bits);
+    ProtocolExecution::prot_exec->feed((block*)server_db.data(), BOB, db_plaintext.get(), server_db.size());
+    int index_bits = 1;
+    while (((size_t)1 << index_bits) < records) {
+        ++index_bits;
+    }
+
+    // (seconds, bytes this party sent) for one lookup, revealed to and checked by ALICE
+    EmpBitOps ops;
+    size_t mismatches = 0;
+    auto measure = [&](function<vector<Bit>(const vector<Bit>&)> lookup) {
+        size_t target = rng() % records;
+        uint64_t bytes_before = io->counter;
+        high_resolution_clock::time_point start = high_resolution_clock::now();
+        vector<Bit> record = lookup(Integer(index_bits, target, ALICE).bits);
+        unique_ptr<bool[]> out(new bool[record_bits]);
+        ProtocolExecution::prot_exec->reveal(out.get(), ALICE, (block*)record.data(), record_bits);
+        double seconds = duration_cast<microseconds>(high_resolution_clock::now() - start).count() / 1e6;
+        if (party == ALICE && !equal(out.get(), out.get() + record_bits, &db_plaintext[target * record_bits])) {
+            ++mismatches;
+        }
+        return make_pair(seconds, (double)(io->counter - bytes_before));
+    };
+
+    pair<double, double> linear(0, 0);
+    for (size_t q = 0; q < LINEAR_SAMPLES; ++q) {
+        pair<double, double> cost = measure([&](const vector<Bit>& index) {
+            vector<Bit> one_hot = decodeOneHot(ops, index, records);
+            return selectByOneHot(ops, one_hot, record_bits, [&](const Bit& selector, size_t x, size_t b) {
+                return selector & server_db[x * record_bits + b];
+            });
+        });
+        linear.first += cost.first / LINEAR_SAMPLES;
+        linear.second += cost.second / LINEAR_SAMPLES;
+    }
+
+    uint64_t init_bytes_before = io->counter;
+    high_resolution_clock::time_point init_start = high_resolution_clock::now();
+    vector<vector<Bit>> rows(records);
+    for (size_t x = 0; x < records; ++x) {
+        rows[x].assign(server_db.begin() + x * record_bits, server_db.begin() + (x + 1) * record_bits);
+    }
+    SqrtOram<EmpBitOps> oram(ops, move(rows), party, ALICE, BOB);
+    pair<double, double> init(duration_cast<microseconds>(high_resolution_clock::now() - init_start).count() / 1e6,
+                              (double)(io->counter - init_bytes_before));
+    vector<pair<double, double>> epoch; // k-th lookup after a shuffle
+    for (size_t q = 0; q < oram.period(); ++q) {
+        epoch.push_back(measure([&](const vector<Bit>& index) { return oram.read(index); }));
+    }
+
+    if (mismatches > 0) {
+        throw runtime_error("ORAM benchmark: " + to_string(mismatches) + " lookups returned the wrong record");
+    }
+    timings["Linear Lookup"] = linear.first;
+    timings["ORAM Init (per epoch)"] = init.first;
+    double epoch_seconds = 0;
+    for (const auto& cost : epoch) {
+        epoch_seconds += cost.first;
+    }
+    timings["ORAM Lookup (epoch mean)"] = epoch_seconds / epoch.size();
+
+    if (party == ALICE) {
+        cout << "\n--- Amortized cost per lookup: " << records << " x " << record_bits << "-bit records, "
+             << oram.period() << " ORAM lookups per epoch (bytes: ALICE -> BOB) ---" << endl;
+        cout << setw(9) << "Lookups" << setw(14) << "Linear (s)" << setw(14) << "ORAM (s)"
+             << setw(14) << "Linear (KB)" << setw(14) << "ORAM (KB)" << setw(12) << "Speedup" << endl;
+        for (size_t lookups : SESSION_LENGTHS) {
+            size_t epochs = (lookups + epoch.size() - 1) / epoch.size();
+            pair<double, double> oram_total(epochs * init.first, epochs * init.second);
+            for (size_t q = 0; q < lookups; ++q) {
+                oram_total.first += epoch[q % epoch.size()].first;
+                oram_total.second += epoch[q % epoch.size()].second;
+            }
+            cout << setw(9) << lookups << setw(14) << linear.first << setw(14) << oram_total.first / lookups
+                 << setw(14) << linear.second / 1024 << setw(14) << oram_total.second / lookups / 1024
+                 << setw(11) << linear.first * lookups / oram_total.first << "x" << endl;
+        }
+    }
 }
 #endif // USE_EMP
 
@@ -383,39 +741,91 @@ int main(int argc, char** argv) {
     string server_ip = "127.0.0.1"; // Default
 
     // --- Argument Parsing ---
-    if (argc < 3) {
+    // gc-mem and net-sim play both parties in this process and take no PARTY_ID
+    bool single_process = argc >= 2 && (string(argv[1]) == "gc-mem" || string(argv[1]) == "net-sim"
+                                        || string(argv[1]) == "oram-bench");
+    if (argc < 3 && !single_process) {
         cerr << "Usage: ./pir_compare PROTOCOL PARTY_ID [PORT SERVER_IP | options...]" << endl;
-        cerr << "  PROTOCOL: 'gc' or 'he'" << endl;
+        cerr << "       ./pir_compare gc-mem [PORT]" << endl;
+        cerr << "       ./pir_compare net-sim [PROFILE]" << endl;
+        cerr << "       ./pir_compare oram-bench [RECORDS [RECORD_BITS]]" << endl;
+        cerr << "  PROTOCOL: 'gc', 'gc-oram', 'gc-mem', 'net-sim', 'oram-bench' or 'he'" << endl;
         cerr << "  PARTY_ID: 1 (Client/ALICE) or 2 (Server/BOB)" << endl;
         cerr << "  For 'gc': PORT SERVER_IP (SERVER_IP needed for client)" << endl;
+        cerr << "  For 'gc-oram': as 'gc', but a session of lookups through a square-root ORAM" << endl;
+        cerr << "  For 'gc-mem': both parties run in this process, over shared memory and then" << endl;
+        cerr << "    over loopback TCP on PORT (default 12345), to separate kernel networking cost" << endl;
+        cerr << "  For 'net-sim': end-to-end GC and HE latency over emulated links;" << endl;
+        cerr << "    PROFILE is LAN, WAN or mobile (default: all of them)" << endl;
+        cerr << "  For 'oram-bench': amortized ORAM vs linear-scan lookups, both parties in this" << endl;
+        cerr << "    process (default 4096 records of 32 bits)" << endl;
         cerr << "  For 'he': (No extra args needed for this simulation)" << endl;
         return 1;
     }
 
     protocol = argv[1];
-    party = atoi(argv[2]);
+    vector<NetworkProfile> profiles(begin(NETWORK_PROFILES), end(NETWORK_PROFILES));
+    size_t oram_records = 4096;
+    int oram_record_bits = 32;
+    if (protocol == "gc-mem") {
+        party = 1; // one process plays both; the summary is ALICE's view
+        port = argc > 2 ? atoi(argv[2]) : 12345;
+    } else if (protocol == "net-sim") {
+        party = 1;
+        if (argc > 2) {
+            const NetworkProfile* profile = findNetworkProfile(argv[2]);
+            if (!profile) {
+                cerr << "Error: unknown network profile '" << argv[2] << "'" << endl; return 1;
+            }
+            profiles.assign(1, *profile);
+        }
+    } else if (protocol == "oram-bench") {
+        party = 1;
+        if (argc > 2) oram_records = strtoul(argv[2], nullptr, 10);
+        if (argc > 3) oram_record_bits = atoi(argv[3]);
+        if (oram_records < 2 || oram_record_bits < 1) {
+            cerr << "Error: oram-bench needs at least 2 records of at least 1 bit" << endl; return 1;
+        }
+    } else {
+        party = atoi(argv[2]);
+    }
 
-    if (protocol != "gc" && protocol != "he") {
-        cerr << "Error: PROTOCOL must be 'gc' or 'he'" << endl; return 1;
+    if (protocol != "gc" && protocol != "gc-oram" && protocol != "gc-mem" && protocol != "net-sim"
+        && protocol != "oram-bench" && protocol != "he") {
+        cerr << "Error: PROTOCOL must be 'gc', 'gc-oram', 'gc-mem', 'net-sim', 'oram-bench' or 'he'" << endl; return 1;
     }
     if (party != 1 && party != 2) {
         cerr << "Error: PARTY_ID must be 1 (ALICE) or 2 (BOB)" << endl; return 1;
     }
 
-    if (protocol == "gc") {
+    if (protocol == "gc" || protocol == "gc-oram") {
 #ifndef USE_EMP
         cerr << "Error: GC protocol selected, but code not compiled with USE_EMP defined." << endl; return 1;
 #endif
         if (argc < 4) {
-            cerr << "Error: 'gc' protocol requires PORT." << endl; return 1;
+            cerr << "Error: '" << protocol << "' protocol requires PORT." << endl; return 1;
         }
         port = atoi(argv[3]);
         if (party == 1) { // Client needs server IP
             if (argc < 5) {
-                cerr << "Error: Client (Party 1) for 'gc' requires SERVER_IP." << endl; return 1;
+                cerr << "Error: Client (Party 1) for '" << protocol << "' requires SERVER_IP." << endl; return 1;
             }
             server_ip = argv[4];
         }
+    } else if (protocol == "gc-mem" || protocol == "oram-bench") {
+#ifndef USE_EMP
+        cerr << "Error: GC protocol selected, but code not compiled with USE_EMP defined." << endl; return 1;
+#elif !defined(THREADING)
+        cerr << "Error: '" << protocol << "' runs both GC parties in this process and needs emp-tool built with"
+             << " -DTHREADING." << endl; return 1;
+#endif
+    } else if (protocol == "net-sim") {
+#if defined(USE_EMP) && !defined(THREADING)
+        cerr << "Error: net-sim runs both GC parties in this process and needs emp-tool built with -DTHREADING."
+             << endl; return 1;
+#elif !defined(USE_EMP) && !defined(USE_SEAL)
+        cerr << "Error: net-sim needs USE_EMP (emp-tool built with -DTHREADING), USE_SEAL or both." << endl; return 1;
+#endif
     } else { // protocol == "he"
 #ifndef USE_SEAL
          cerr << "Error: HE protocol selected, but code not compiled with USE_SEAL defined." << endl; return 1;
@@ -433,17 +843,97 @@ int main(int argc, char** argv) {
 
     // --- Execute Selected Protocol ---
     try {
-        if (protocol == "gc") {
+        if (protocol == "gc" || protocol == "gc-oram") {
 #ifdef USE_EMP
             NetIO * io = new NetIO(party == ALICE ? server_ip.c_str() : nullptr, port);
             cout << "[GC Main] Network setup..." << endl;
             setup_semi_honest(io, party);
             cout << "[GC Main] Network setup complete. Running PIR..." << endl;
-            run_pir_gc(io, party, timings);
+            if (protocol == "gc-oram") {
+                run_pir_gc(party, timings, gcTargets(GC_ORAM_SESSION_QUERIES), true);
+            } else {
+                run_pir_gc(party, timings, gcTargets());
+            }
             finalize_semi_honest();
             delete io;
             cout << "[GC Main] Protocol finished." << endl;
 #endif
+        } else if (protocol == "gc-mem") {
+#ifdef USE_EMP
+            // Same run twice: shared-memory rings, then loopback TCP. The
+            // difference per phase is what the kernel's networking costs.
+            uint64_t alice_sent = 0, bob_sent = 0, tcp_alice_sent = 0, tcp_bob_sent = 0;
+            pair<MemIO*, MemIO*> ends = MemIO::createPair();
+            cout << "[GC Main] Running both parties in-process over shared memory..." << endl;
+            map<string, double> mem_timings = run_gc_parties_local<MemIO>(
+                [&] { return ends.first; }, [&] { return ends.second; },
+                [](MemIO*, int io_party, map<string, double>& party_timings) {
+                    run_pir_gc(io_party, party_timings, gcTargets());
+                }, alice_sent, bob_sent);
+            cout << "[GC Main] Running both parties in-process over loopback TCP (port " << port << ")..." << endl;
+            map<string, double> tcp_timings = run_gc_parties_local<NetIO>(
+                [&] { return new NetIO("127.0.0.1", port); }, [&] { return new NetIO(nullptr, port); },
+                [](NetIO*, int io_party, map<string, double>& party_timings) {
+                    run_pir_gc(io_party, party_timings, gcTargets());
+                }, tcp_alice_sent, tcp_bob_sent);
+            for (const auto& phase : mem_timings) {
+                timings[phase.first + " [memory]"] = phase.second;
+                timings[phase.first + " [loopback TCP]"] = tcp_timings[phase.first];
+                timings[phase.first + " [kernel networking]"] = tcp_timings[phase.first] - phase.second;
+            }
+            comm_sizes["GC ALICE -> BOB"] = alice_sent;
+            comm_sizes["GC BOB -> ALICE"] = bob_sent;
+            cout << "[GC Main] Protocol finished." << endl;
+#endif
+        } else if (protocol == "oram-bench") {
+#ifdef USE_EMP
+            uint64_t alice_sent = 0, bob_sent = 0;
+            pair<MemIO*, MemIO*> ends = MemIO::createPair();
+            cout << "[GC Main] Benchmarking ORAM against linear-scan lookups in-process..." << endl;
+            timings = run_gc_parties_local<MemIO>(
+                [&] { return ends.first; }, [&] { return ends.second; },
+                [&](MemIO* io, int io_party, map<string, double>& party_timings) {
+                    benchmarkOram(io, io_party, oram_records, oram_record_bits, party_timings);
+                }, alice_sent, bob_sent);
+            comm_sizes["GC ALICE -> BOB"] = alice_sent;
+            comm_sizes["GC BOB -> ALICE"] = bob_sent;
+#endif
+        } else if (protocol == "net-sim") {
+            // GC runs for real over an emulated link per profile. The HE
+            // simulation has no channel, so its measured query and response
+            // sizes are pushed through the same link model instead.
+#ifdef USE_SEAL
+            map<string, double> he_timings;
+            run_pir_he(he_timings, comm_sizes);
+#endif
+            for (const NetworkProfile& profile : profiles) {
+                ostringstream tag_stream;
+                tag_stream << profile.name << " (" << profile.mbps << " Mbps, " << profile.rtt_ms << " ms RTT)";
+                string tag = tag_stream.str();
+#ifdef USE_EMP
+                uint64_t alice_sent = 0, bob_sent = 0;
+                pair<MemIO*, MemIO*> ends = MemIO::createPair();
+                cout << "[Net Sim] GC over " << tag << "..." << endl;
+                map<string, double> gc_timings = run_gc_parties_local<EmulatedIO<MemIO>>(
+                    [&] { return new EmulatedIO<MemIO>(ends.first, profile, 1); },
+                    [&] { return new EmulatedIO<MemIO>(ends.second, profile, 2); },
+                    [](EmulatedIO<MemIO>*, int io_party, map<string, double>& party_timings) {
+                        run_pir_gc(io_party, party_timings, gcTargets());
+                    }, alice_sent, bob_sent);
+                timings[tag + " GC End-to-End"] = gc_timings["GC End-to-End (incl. OT setup)"];
+                comm_sizes["GC ALICE -> BOB"] = alice_sent;
+                comm_sizes["GC BOB -> ALICE"] = bob_sent;
+#endif
+#ifdef USE_SEAL
+                LinkEmulator uplink(profile, 1), downlink(profile, 2);
+                double he_end_to_end = he_timings["HE Query Encrypt (Client)"];
+                he_end_to_end = uplink.deliveryTime(he_end_to_end, comm_sizes["Client->Server (bytes)"]);
+                he_end_to_end += he_timings["HE Compute (Server)"];
+                he_end_to_end = downlink.deliveryTime(he_end_to_end, comm_sizes["Server->Client (bytes)"]);
+                he_end_to_end += he_timings["HE Result Decrypt (Client)"];
+                timings[tag + " HE End-to-End (excl. KeyGen)"] = he_end_to_end;
+#endif
+            }
         } else { // protocol == "he"
 #ifdef USE_SEAL
             // In this version, party 1 simulates both client and server sequentially
@@ -0,0 +1,112 @@
+#ifndef SELECTION_CIRCUIT_H
+#define SELECTION_CIRCUIT_H
+
+#include <vector>
+#include <cstddef>
+#include <utility>
+
+// Index -> value selection circuits, shared by the standalone garbler
+// (garbled_circuit_pir.cpp) and the EMP path (pir_client_data.cpp).
+// The builders are generic over a bit-ops policy:
+//
+//   struct Ops {
+//       using Bit = ...;
+//       Bit AND(Bit a, Bit b);
+//       Bit XOR(Bit a, Bit b);
+//       Bit NOT(Bit a);
+//   };
+//
+// which may append gates to a circuit or operate on EMP bits directly.
+// NOT and XOR are assumed free (Free-XOR), so only ANDs are counted.
+
+// One-hot vector of an index given as two one-hot halves:
+// out[x] = high[x / low.size()] AND low[x % low.size()], for x < count.
+// Exactly count ANDs.
+template<typename Ops>
+std::vector<typename Ops::Bit> combineOneHot(Ops& ops, const std::vector<typename Ops::Bit>& high,
+                                             const std::vector<typename Ops::Bit>& low, size_t count) {
+    std::vector<typename Ops::Bit> out;
+    out.reserve(count);
+    for (size_t x = 0; x < count; x++) {
+        out.push_back(ops.AND(high[x / low.size()], low[x % low.size()]));
+    }
+    return out;
+}
+
+// Binary decoder: out[x] = (index == x) for x < count, index LSB first.
+// The bits are split in half and each half decoded recursively, so all
+// prefix ANDs are shared: count + O(sqrt(count)) ANDs in total, with AND
+// depth ceil(log2(index.size())).
+template<typename Ops>
+std::vector<typename Ops::Bit> decodeOneHot(Ops& ops, const std::vector<typename Ops::Bit>& index, size_t count) {
+    if (index.size() == 1) {
+        std::vector<typename Ops::Bit> out{ops.NOT(index[0]), index[0]};
+        if (count < out.size()) {
+            out.resize(count);
+        }
+        return out;
+    }
+    size_t low_bits = index.size() / 2;
+    size_t low_count = (size_t)1 << low_bits;
+    std::vector<typename Ops::Bit> low_index(index.begin(), index.begin() + low_bits);
+    std::vector<typename Ops::Bit> high_index(index.begin() + low_bits, index.end());
+    std::vector<typename Ops::Bit> low = decodeOneHot(ops, low_index, count < low_count ? count : low_count);
+    std::vector<typename Ops::Bit> high = decodeOneHot(ops, high_index, (count + low_count - 1) / low_count);
+    return combineOneHot(ops, high, low, count);
+}
+
+// XOR of count rows, where row(x) returns row x as a vector of bits.
+// Rows are folded in as they are produced, binary-counter style: a row
+// at level k absorbs the next level-k row, so the tree is balanced (log
+// depth) and only O(log count) partial rows are ever live. Each step
+// combines two whole rows, so wires are read and written sequentially
+// however wide the rows are.
+template<typename Ops, typename Row>
+std::vector<typename Ops::Bit> xorRows(Ops& ops, size_t count, Row row) {
+    std::vector<std::pair<std::vector<typename Ops::Bit>, size_t>> partial; // (row, level)
+    for (size_t x = 0; x < count; x++) {
+        std::vector<typename Ops::Bit> sum = row(x);
+        size_t level = 0;
+        while (!partial.empty() && partial.back().second == level) {
+            for (size_t b = 0; b < sum.size(); b++) {
+                sum[b] = ops.XOR(partial.back().first[b], sum[b]);
+            }
+            partial.pop_back();
+            level++;
+        }
+        partial.emplace_back(std::move(sum), level);
+    }
+    std::vector<typename Ops::Bit> sum = std::move(partial.back().first);
+    partial.pop_back();
+    while (!partial.empty()) {
+        for (size_t b = 0; b < sum.size(); b++) {
+            sum[b] = ops.XOR(partial.back().first[b], sum[b]);
+        }
+        partial.pop_back();
+    }
+    return sum;
+}
+
+// Selected value from a one-hot vector: bit b of the result is the XOR
+// over x of (one_hot[x] AND value bit b of x). masked_bit(selector, x, b)
+// returns that AND, so callers can use a cheaper gate when the value bit
+// is known to one party.
+//
+// Everything is laid out record by record (bit-sliced): one selector's
+// fan-out across all value bits is a contiguous run that an engine can
+// hash in one batch, and xorRows folds each record in as soon as it is
+// masked.
+template<typename Ops, typename MaskedBit>
+std::vector<typename Ops::Bit> selectByOneHot(Ops& ops, const std::vector<typename Ops::Bit>& one_hot,
+                                              size_t value_bits, MaskedBit masked_bit) {
+    return xorRows(ops, one_hot.size(), [&](size_t x) {
+        std::vector<typename Ops::Bit> row;
+        row.reserve(value_bits);
+        for (size_t b = 0; b < value_bits; b++) {
+            row.push_back(masked_bit(one_hot[x], x, b));
+        }
+        return row;
+    });
+}
+
+#endif // SELECTION_CIRCUIT_H
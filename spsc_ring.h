@@ -0,0 +1,99 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+// Bounded single-producer / single-consumer ring buffer. Exactly one
+// thread may call tryPush and one other thread tryPop. There are no locks:
+// each side owns one index and publishes it with release ordering, and
+// keeps a cached copy of the other side's index so the shared cache line
+// is only read when the ring looks full (or empty).
+template<typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t min_capacity) {
+        size_t capacity = 1;
+        while (capacity < min_capacity) {
+            capacity <<= 1;
+        }
+        slots.resize(capacity);
+        mask = capacity - 1;
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+    bool tryPush(const T& value) {
+        size_t tail = tail_index.load(std::memory_order_relaxed);
+        if (tail - cached_head > mask) {
+            cached_head = head_index.load(std::memory_order_acquire);
+            if (tail - cached_head > mask) {
+                return false;
+            }
+        }
+        slots[tail & mask] = value;
+        tail_index.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& value) {
+        size_t head = head_index.load(std::memory_order_relaxed);
+        if (head == cached_tail) {
+            cached_tail = tail_index.load(std::memory_order_acquire);
+            if (head == cached_tail) {
+                return false;
+            }
+        }
+        value = slots[head & mask];
+        head_index.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Bulk variants for byte streams: move up to count elements (in at most
+    // two contiguous copies around the wrap point) and return how many moved.
+    size_t tryPushSome(const T* data, size_t count) {
+        size_t tail = tail_index.load(std::memory_order_relaxed);
+        size_t free_slots = capacity() - (tail - cached_head);
+        if (free_slots < count) {
+            cached_head = head_index.load(std::memory_order_acquire);
+            free_slots = capacity() - (tail - cached_head);
+        }
+        size_t moved = std::min(count, free_slots);
+        size_t first = std::min(moved, capacity() - (tail & mask));
+        std::copy(data, data + first, slots.data() + (tail & mask));
+        std::copy(data + first, data + moved, slots.data());
+        tail_index.store(tail + moved, std::memory_order_release);
+        return moved;
+    }
+
+    size_t tryPopSome(T* data, size_t count) {
+        size_t head = head_index.load(std::memory_order_relaxed);
+        size_t available = cached_tail - head;
+        if (available < count) {
+            cached_tail = tail_index.load(std::memory_order_acquire);
+            available = cached_tail - head;
+        }
+        size_t moved = std::min(count, available);
+        size_t first = std::min(moved, capacity() - (head & mask));
+        std::copy(slots.data() + (head & mask), slots.data() + (head & mask) + first, data);
+        std::copy(slots.data(), slots.data() + (moved - first), data + first);
+        head_index.store(head + moved, std::memory_order_release);
+        return moved;
+    }
+
+private:
+    std::vector<T> slots;
+    size_t mask = 0;
+
+    // Consumer side
+    alignas(64) std::atomic<size_t> head_index{0};
+    size_t cached_tail = 0;
+
+    // Producer side
+    alignas(64) std::atomic<size_t> tail_index{0};
+    size_t cached_head = 0;
+};
+
+#endif // SPSC_RING_H
@@ -0,0 +1,354 @@
+#ifndef SQRT_ORAM_H
+#define SQRT_ORAM_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "selection_circuit.h"
+
+// Read-only square-root ORAM for two-party computation (after Zahur et
+// al., "Revisiting Square-Root ORAM"). One O(N log N) shuffle per epoch
+// lets each of the next T lookups touch a single publicly revealed
+// position, plus a scan of the at most T records already touched, instead
+// of a circuit over all N records.
+//
+// Generic over the bit-ops policy of selection_circuit.h, extended with:
+//
+//   struct Ops {
+//       ...
+//       Bit constant(bool value);                                        // public constant
+//       std::vector<Bit> feed(int owner, const std::vector<bool>& bits); // owner's private bits
+//       uint64_t revealPublic(const std::vector<Bit>& bits);             // LSB first, to both parties
+//       uint64_t randomWord();                                           // local secret randomness
+//   };
+//
+// Every party must make the same calls in the same order; feed ignores
+// the bits of parties other than owner.
+
+// Switches in a Benes network on size (a power of two) inputs
+inline size_t benesSwitchCount(size_t size) {
+    size_t levels = 0;
+    while (((size_t)1 << levels) < size) {
+        levels++;
+    }
+    return size * levels - size / 2;
+}
+
+// Appends the switch settings (true = crossed) that make a Benes network
+// send input a to output dst[a], in the order applyBenes consumes them:
+// input column, upper half, lower half, output column. This is the usual
+// looping algorithm: inputs sharing a switch go to different halves, and
+// so do the inputs feeding one output switch.
+inline void routeBenes(const std::vector<size_t>& dst, std::vector<bool>& switches) {
+    size_t size = dst.size();
+    if (size == 2) {
+        switches.push_back(dst[0] == 1);
+        return;
+    }
+    size_t half = size / 2;
+    std::vector<size_t> src(size);
+    for (size_t a = 0; a < size; a++) {
+        src[dst[a]] = a;
+    }
+    std::vector<int> side(size, -1); // 0 = upper half, 1 = lower half
+    for (size_t start = 0; start < size; start += 2) {
+        size_t a = start;
+        while (side[a] < 0) {
+            side[a] = 0;
+            side[a ^ 1] = 1;
+            // a's partner goes low, so its output's partner must come from the upper half
+            a = src[dst[a ^ 1] ^ 1];
+        }
+    }
+    std::vector<size_t> upper(half), lower(half);
+    for (size_t a = 0; a < size; a++) {
+        (side[a] == 0 ? upper : lower)[a / 2] = dst[a] / 2;
+    }
+    for (size_t i = 0; i < half; i++) {
+        switches.push_back(side[2 * i] == 1);
+    }
+    routeBenes(upper, switches);
+    routeBenes(lower, switches);
+    for (size_t o = 0; o < half; o++) {
+        switches.push_back(side[src[2 * o]] == 1);
+    }
+}
+
+// Swaps rows x and y when swap is set: one AND per bit
+template<typename Ops>
+void conditionalSwap(Ops& ops, std::vector<typename Ops::Bit>& x, std::vector<typename Ops::Bit>& y,
+                     const typename Ops::Bit& swap) {
+    for (size_t b = 0; b < x.size(); b++) {
+        typename Ops::Bit diff = ops.AND(swap, ops.XOR(x[b], y[b]));
+        x[b] = ops.XOR(x[b], diff);
+        y[b] = ops.XOR(y[b], diff);
+    }
+}
+
+// Permutes rows through a Benes network with secret switches (routed by
+// routeBenes, starting at offset). The inverse runs the same switches back
+// to front, so it undoes the forward pass.
+template<typename Ops>
+void applyBenes(Ops& ops, std::vector<std::vector<typename Ops::Bit>>& rows,
+                const std::vector<typename Ops::Bit>& switches, size_t offset, bool inverse) {
+    size_t size = rows.size();
+    if (size == 2) {
+        conditionalSwap(ops, rows[0], rows[1], switches[offset]);
+        return;
+    }
+    size_t half = size / 2;
+    size_t upper_offset = offset + half;
+    size_t lower_offset = upper_offset + benesSwitchCount(half);
+    size_t output_offset = lower_offset + benesSwitchCount(half);
+    auto column = [&](size_t column_offset) {
+        for (size_t i = 0; i < half; i++) {
+            conditionalSwap(ops, rows[2 * i], rows[2 * i + 1], switches[column_offset + i]);
+        }
+    };
+
+    column(inverse ? output_offset : offset);
+    std::vector<std::vector<typename Ops::Bit>> upper(half), lower(half);
+    for (size_t i = 0; i < half; i++) {
+        upper[i] = std::move(rows[2 * i]);
+        lower[i] = std::move(rows[2 * i + 1]);
+    }
+    applyBenes(ops, upper, switches, upper_offset, inverse);
+    applyBenes(ops, lower, switches, lower_offset, inverse);
+    for (size_t i = 0; i < half; i++) {
+        rows[2 * i] = std::move(upper[i]);
+        rows[2 * i + 1] = std::move(lower[i]);
+    }
+    column(inverse ? offset : output_offset);
+}
+
+template<typename Ops>
+class SqrtOram {
+public:
+    using Bit = typename Ops::Bit;
+    using Row = std::vector<Bit>;
+
+    // Position map entries packed per record of the next level down
+    static constexpr size_t POSMAP_PACK = 8;
+
+    // records are secret and all the same width. Each epoch serves period
+    // lookups before the next reshuffle; 0 picks the period with the lowest
+    // estimated cost per lookup (around sqrt(N log N)). Both
+    // shufflers pick a secret permutation, so neither knows the layout.
+    SqrtOram(Ops& ops, std::vector<Row> records, int self, int shuffler_a, int shuffler_b, size_t period = 0)
+        : ops(ops), records(std::move(records)), self(self), shuffler_a(shuffler_a), shuffler_b(shuffler_b) {
+        size_t count = this->records.size();
+        if (period == 0) {
+            period = 1;
+            for (size_t candidate = 2; candidate <= count; candidate++) {
+                if (lookupCost(count, width(), candidate) < lookupCost(count, width(), period)) {
+                    period = candidate;
+                }
+            }
+        }
+        epoch_length = period;
+        physicalSize(count + epoch_length, physical_size, index_bits);
+        reshuffle();
+    }
+
+    size_t period() const { return epoch_length; }
+    size_t epochs() const { return epoch_count; }
+
+    // Record at a secret index (LSB first, below the record count)
+    Row read(const Row& index) {
+        if (accesses == epoch_length) {
+            reshuffle();
+        }
+        Row virtual_index(index.begin(), index.begin() + std::min(index.size(), index_bits));
+        while (virtual_index.size() < index_bits) {
+            virtual_index.push_back(ops.constant(false));
+        }
+
+        // Touched before in this epoch? Ids in the stash are distinct, so
+        // at most one entry matches and the OR of the matches is their XOR.
+        Bit found = ops.constant(false);
+        Row stashed(width(), ops.constant(false));
+        for (const auto& entry : stash) {
+            Bit match = equal(entry.first, virtual_index);
+            found = ops.XOR(found, match);
+            for (size_t b = 0; b < stashed.size(); b++) {
+                stashed[b] = ops.XOR(stashed[b], ops.AND(match, entry.second[b]));
+            }
+        }
+
+        // If so, spend this epoch's next dummy so the revealed position is fresh
+        size_t dummy = records.size() + accesses;
+        for (size_t b = 0; b < index_bits; b++) {
+            Bit dummy_bit = ops.constant((dummy >> b) & 1);
+            virtual_index[b] = ops.XOR(virtual_index[b], ops.AND(found, ops.XOR(virtual_index[b], dummy_bit)));
+        }
+        size_t position = ops.revealPublic(lookupPosition(virtual_index));
+        const Row& fetched = physical[position];
+
+        Row out(width());
+        for (size_t b = 0; b < out.size(); b++) {
+            out[b] = ops.XOR(fetched[b], ops.AND(found, ops.XOR(fetched[b], stashed[b])));
+        }
+        stash.emplace_back(std::move(virtual_index), fetched);
+        accesses++;
+        return out;
+    }
+
+private:
+    size_t width() const { return records.empty() ? 0 : records[0].size(); }
+
+    Bit equal(const Row& x, const Row& y) {
+        Bit result = ops.NOT(ops.XOR(x[0], y[0]));
+        for (size_t b = 1; b < x.size(); b++) {
+            result = ops.AND(result, ops.NOT(ops.XOR(x[b], y[b])));
+        }
+        return result;
+    }
+
+    Row constantRow(size_t value, size_t bits) {
+        Row row;
+        for (size_t b = 0; b < bits; b++) {
+            row.push_back(ops.constant((value >> b) & 1));
+        }
+        return row;
+    }
+
+    // Switch bits of a fresh random permutation, routed by owner and fed
+    // privately; the other party contributes zeros
+    Row secretPermutation(int owner) {
+        std::vector<bool> switches;
+        if (owner == self) {
+            std::vector<size_t> dst(physical_size);
+            for (size_t a = 0; a < physical_size; a++) {
+                dst[a] = a;
+            }
+            for (size_t a = physical_size - 1; a > 0; a--) {
+                std::swap(dst[a], dst[ops.randomWord() % (a + 1)]);
+            }
+            routeBenes(dst, switches);
+        } else {
+            switches.assign(benesSwitchCount(physical_size), false);
+        }
+        return ops.feed(owner, switches);
+    }
+
+    // New epoch: shuffle records and dummies under both parties' secret
+    // permutations, then send the identity through the inverse networks
+    // so entry j of the position map holds where record j now lives
+    void reshuffle() {
+        Row switches_a = secretPermutation(shuffler_a);
+        Row switches_b = secretPermutation(shuffler_b);
+
+        physical = records;
+        physical.resize(physical_size, Row(width(), ops.constant(false)));
+        applyBenes(ops, physical, switches_a, 0, false);
+        applyBenes(ops, physical, switches_b, 0, false);
+
+        std::vector<Row> positions;
+        for (size_t p = 0; p < physical_size; p++) {
+            positions.push_back(constantRow(p, index_bits));
+        }
+        applyBenes(ops, positions, switches_b, 0, true);
+        applyBenes(ops, positions, switches_a, 0, true);
+
+        bool recurse = false;
+        positionMapCost(physical_size, index_bits, epoch_length, &recurse);
+        if (recurse) {
+            size_t packed_count = (physical_size + POSMAP_PACK - 1) / POSMAP_PACK;
+            std::vector<Row> packed(packed_count);
+            for (size_t p = 0; p < physical_size; p++) {
+                Row& block = packed[p / POSMAP_PACK];
+                block.insert(block.end(), positions[p].begin(), positions[p].end());
+            }
+            for (Row& block : packed) {
+                block.resize(POSMAP_PACK * index_bits, ops.constant(false));
+            }
+            position_map.clear();
+            position_oram.reset(new SqrtOram(ops, std::move(packed), self, shuffler_a, shuffler_b, epoch_length));
+        } else {
+            position_oram.reset();
+            position_map = std::move(positions);
+        }
+
+        stash.clear();
+        accesses = 0;
+        epoch_count++;
+    }
+
+    // Smallest power of two holding count rows, and its log2
+    static void physicalSize(size_t count, size_t& size, size_t& bits) {
+        size = 2;
+        bits = 1;
+        while (size < count) {
+            size <<= 1;
+            bits++;
+        }
+    }
+
+    // Estimated ANDs per lookup, reshuffles spread over the epoch: stash
+    // scan, muxes, the two shuffle networks for records and positions, and
+    // the position map
+    static double lookupCost(size_t count, size_t width, size_t period) {
+        size_t size, bits;
+        physicalSize(count + period, size, bits);
+        return period / 2.0 * (bits + width) + bits + width
+             + 2.0 * benesSwitchCount(size) * (width + bits) / period
+             + positionMapCost(size, bits, period);
+    }
+
+    // Estimated ANDs to find a virtual index's position: scan the whole
+    // map, or read it from a packed smaller ORAM, whichever is cheaper.
+    // *recurse says which.
+    static double positionMapCost(size_t size, size_t bits, size_t period, bool* recurse = nullptr) {
+        double scan = size * (bits + 1.0);
+        size_t count = (size + POSMAP_PACK - 1) / POSMAP_PACK;
+        size_t child_size, child_bits;
+        physicalSize(count + period, child_size, child_bits);
+        double oram = scan;
+        if (size > POSMAP_PACK && child_size < size) {
+            oram = lookupCost(count, POSMAP_PACK * bits, period) + POSMAP_PACK * (bits + 1.0);
+        }
+        if (recurse) {
+            *recurse = oram < scan;
+        }
+        return std::min(scan, oram);
+    }
+
+    Row lookupPosition(const Row& virtual_index) {
+        if (!position_oram) {
+            std::vector<Bit> one_hot = decodeOneHot(ops, virtual_index, physical_size);
+            return selectByOneHot(ops, one_hot, index_bits, [&](const Bit& selector, size_t p, size_t b) {
+                return ops.AND(selector, position_map[p][b]);
+            });
+        }
+        size_t slot_bits = 0;
+        while (((size_t)1 << slot_bits) < POSMAP_PACK) {
+            slot_bits++;
+        }
+        Row slot(virtual_index.begin(), virtual_index.begin() + slot_bits);
+        Row block_index(virtual_index.begin() + slot_bits, virtual_index.end());
+        Row block = position_oram->read(block_index);
+        std::vector<Bit> one_hot = decodeOneHot(ops, slot, POSMAP_PACK);
+        return selectByOneHot(ops, one_hot, index_bits, [&](const Bit& selector, size_t e, size_t b) {
+            return ops.AND(selector, block[e * index_bits + b]);
+        });
+    }
+
+    Ops& ops;
+    std::vector<Row> records;
+    int self, shuffler_a, shuffler_b;
+    size_t epoch_length = 0;
+    size_t physical_size = 0;  // records plus dummies, padded to a power of two
+    size_t index_bits = 0;     // log2(physical_size)
+
+    std::vector<Row> physical;                 // shuffled records, fetched by revealed position
+    std::vector<std::pair<Row, Row>> stash;    // (virtual index, record) touched this epoch
+    std::vector<Row> position_map;             // scanned directly at the last level
+    std::unique_ptr<SqrtOram> position_oram;   // otherwise packed into a smaller ORAM
+    size_t accesses = 0;
+    size_t epoch_count = 0;
+};
+
+#endif // SQRT_ORAM_H